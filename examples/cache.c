@@ -0,0 +1,73 @@
+#include "../jsJSON.h" 
+#include <stdio.h>
+#include <stdlib.h> // malloc(), free()
+#include <string.h> // strcmp()
+#include <stdbool.h> // bool
+#include <stdint.h> // uint64_t
+
+int main() {
+    // a status document where the build information never changes
+    // but the counters do
+    jsJSON* root = jsJSON_newObject(NULL);
+    jsJSON* build = jsJSON_addObject(root, "build");
+    jsJSON_addString(build, "version", "1.2.3");
+    jsJSON_addString(build, "commit", "0123456789abcdef");
+    jsJSON_addBoolean(build, "debug", false);
+    jsJSON* counters = jsJSON_addObject(root, "counters");
+    jsJSON_addNumber(counters, "requests", 0);
+
+    // the build object is formatted once and then copied from its cache
+    jsJSON_setCacheable(build, true);
+
+    char buffer[1000];
+    jsJSON_serializeToStr(root, buffer, sizeof(buffer));
+    printf("%s\n", buffer);
+    bool ok = build->cache->bytes != NULL && !build->cache->isDirty;
+
+    // changing a counter leaves the build cache alone
+    jsJSON_setNumber(counters, "requests", 1);
+    jsJSON_serializeToStr(root, buffer, sizeof(buffer));
+    printf("%s\n", buffer);
+    ok = ok && !build->cache->isDirty
+            && strcmp(buffer, "{\"build\": {\"version\": \"1.2.3\", \"commit\": \"0123456789abcdef\", \"debug\": false}, \"counters\": {\"requests\": 1.000000}}") == 0;
+
+    // changing something inside the build object invalidates its cache
+    jsJSON_setBoolean(build, "debug", true);
+    ok = ok && build->cache->isDirty;
+    jsJSON_serializeToStr(root, buffer, sizeof(buffer));
+    printf("%s\n", buffer);
+    ok = ok && !build->cache->isDirty
+            && strcmp(build->cache->bytes, "{\"version\": \"1.2.3\", \"commit\": \"0123456789abcdef\", \"debug\": true}") == 0;
+
+    // a node that is only ever sent as an iovec list is cached, too,
+    // and referenced from the second serialization on
+    jsJSON_setCacheable(counters, true);
+    jsJSON_iovec iov[16];
+    char scratch[256];
+    jsJSON_serializeToIovec(root, iov, 16, scratch, sizeof(scratch), 1024);
+    ok = ok && counters->cache->bytes != NULL
+            && strcmp(counters->cache->bytes, "{\"requests\": 1.000000}") == 0;
+    size_t count = jsJSON_serializeToIovec(root, iov, 16, scratch, sizeof(scratch), 1024);
+    bool referenced = false;
+    for( size_t i = 0; i < count; i++ ) {
+        referenced = referenced || iov[i].base == counters->cache->bytes;
+    }
+    ok = ok && referenced;
+
+    // caches nested in caches are invalidated all the way up
+    jsJSON_setCacheable(root, true);
+    jsJSON_serializeToStr(root, buffer, sizeof(buffer));
+    jsJSON_setNumber(counters, "requests", 2);
+    jsJSON_serializeToStr(root, buffer, sizeof(buffer));
+    printf("%s\n", buffer);
+    ok = ok && strstr(buffer, "\"requests\": 2.000000") != NULL;
+
+    jsJSON_free(root);
+
+    if( !ok ) {
+        printf("cached serialization does not match\n");
+        return 1;
+    }
+    return 0;
+}
+
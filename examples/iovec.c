@@ -0,0 +1,64 @@
+#include "../jsJSON.h" 
+#include <stdio.h>
+#include <stdlib.h> // malloc(), free()
+#include <string.h> // strcmp()
+#include <stdbool.h> // bool
+#include <stdint.h> // uint64_t
+
+int main() {
+    // let's build a message that carries a large payload, for example
+    // a base64 encoded blob that we do not want to copy around
+    char blob[4096];
+    memset(blob, 'A', sizeof(blob) - 1);
+    blob[sizeof(blob) - 1] = '\0';
+
+    jsJSON* root = jsJSON_newObject(NULL);
+    jsJSON_addString(root, "type", "upload");
+    jsJSON_addNumber(root, "size", sizeof(blob) - 1);
+    jsJSON* payload = jsJSON_addString(root, "payload", blob);
+    jsJSON_addBoolean(root, "compressed", false);
+
+    // serialize into an iovec list. Everything but the payload ends up
+    // in the small scratch buffer, the payload is referenced in place.
+    // On POSIX systems the entries can be passed to writev() directly.
+    jsJSON_iovec iov[16];
+    char scratch[256];
+    size_t count = jsJSON_serializeToIovec(root, iov, 16, scratch, sizeof(scratch), 1024);
+    if( count == 0 ) {
+        printf("iovec or scratch buffer too small\n");
+        return 1;
+    }
+
+    bool referenced = false;
+    for( size_t i = 0; i < count; i++ ) {
+        if( iov[i].base == payload->stringValue ) {
+            referenced = true;
+        }
+        printf("entry %zu: %zu bytes%s\n", i, iov[i].length, iov[i].base == payload->stringValue ? " (referenced)" : "");
+    }
+
+    // the concatenated entries must be the same as the plain serialization
+    char* expected = malloc(8192);
+    size_t expectedLength = jsJSON_serializeToStr(root, expected, 8192);
+    size_t offset = 0;
+    bool equal = true;
+    for( size_t i = 0; i < count; i++ ) {
+        if( offset + iov[i].length > expectedLength
+         || memcmp(expected + offset, iov[i].base, iov[i].length) != 0 ) {
+            equal = false;
+            break;
+        }
+        offset += iov[i].length;
+    }
+    equal = equal && offset == expectedLength;
+
+    free(expected);
+    jsJSON_free(root);
+
+    if( !referenced || !equal ) {
+        printf("vectored serialization does not match\n");
+        return 1;
+    }
+    return 0;
+}
+
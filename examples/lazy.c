@@ -0,0 +1,54 @@
+#include "../jsJSON.h" 
+#include <stdio.h>
+#include <stdlib.h> // malloc(), free()
+#include <string.h> // strcmp()
+#include <stdbool.h> // bool
+#include <stdint.h> // uint64_t
+
+int main() {
+    // in lazy mode the parser does not convert numbers or copy strings,
+    // it only remembers where they are in the JSON string. That's why the
+    // JSON string has to stay around as long as we use the tree.
+    char* json = "{\"type\":\"chatter message\",\"sender\":\"Alice\",\"counter\":42.5,\"payload\": {\"field1\":\"value1\",\"field2\":\"value2\"}}";
+    printf("%s\n", json);
+    jsJSON* root = jsJSON_parseWithFlags(json, jsJSON_PARSE_LAZY);
+
+    // values are converted on first access and cached in the node
+    char* sender = jsJSON_getString(root, "sender");
+    double counter = jsJSON_getNumber(root, "counter");
+    printf("sender: %s, counter: %f\n", sender, counter);
+
+    // fields that we never touched are still unconverted
+    jsJSON* payload = jsJSON_getObject(root, "payload");
+    bool untouched = payload->children->isPending;
+
+    // vectored output references large values straight in the input
+    // without converting them
+    jsJSON_iovec iov[16];
+    char scratch[256];
+    size_t count = jsJSON_serializeToIovec(root, iov, 16, scratch, sizeof(scratch), 6);
+    bool referenced = false;
+    for( size_t i = 0; i < count; i++ ) {
+        referenced = referenced || iov[i].base == strstr(json, "value1");
+    }
+    untouched = untouched && referenced && payload->children->isPending;
+
+    // serializing converts whatever is left
+    char buffer[1000];
+    jsJSON_serializeToStr(root, buffer, sizeof(buffer));
+    printf("%s\n", buffer);
+
+    bool ok = untouched
+           && strcmp(sender, "Alice") == 0
+           && counter == 42.5
+           && strcmp(jsJSON_getString(payload, "field1"), "value1") == 0;
+
+    jsJSON_free(root);
+
+    if( !ok ) {
+        printf("lazy parsing does not match\n");
+        return 1;
+    }
+    return 0;
+}
+
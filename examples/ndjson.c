@@ -0,0 +1,72 @@
+#include "../jsJSON.h" 
+#include <stdio.h>
+#include <stdlib.h> // malloc(), free()
+#include <string.h> // strcmp()
+#include <stdbool.h> // bool
+#include <stdint.h> // uint64_t
+
+int main() {
+    // a log stream with one JSON record per line
+    char* log =
+        "{\"sender\":\"Bob\",\"payload\":{\"priority\":5}}\n"
+        "{\"sender\":\"Alice\",\"payload\":{\"priority\":1}}\n"
+        "{\"note\":\"Alice was here\",\"sender\":\"Carol\",\"payload\":{\"priority\":9}}\n"
+        "{\"sender\":\"Alice\",\"payload\":{\"priority\":7,\"text\":\"urgent\"}}\n"
+        "{\"sender\": \"Alice\", \"payload\": {\"priority\": 3}}\n";
+    printf("%s", log);
+
+    // select the records sent by Alice with a priority above 2. The
+    // lines are filtered on the raw text, only matches are parsed.
+    jsJSON_Filter filters[2];
+    filters[0].path = "sender";
+    filters[0].op = jsJSON_FILTER_STRING_EQUALS;
+    filters[0].stringValue = "Alice";
+    filters[1].path = "payload.priority";
+    filters[1].op = jsJSON_FILTER_NUMBER_GREATER;
+    filters[1].numberValue = 2;
+
+    jsJSON_Span matches[8];
+    size_t consumed = 0;
+    size_t count = jsJSON_filterLines(filters, 2, log, strlen(log), true, matches, 8, &consumed);
+
+    bool ok = count == 2 && consumed == strlen(log);
+    for( size_t i = 0; i < count; i++ ) {
+        jsJSON* root = jsJSON_parseWithLength(matches[i].start, matches[i].length, jsJSON_PARSE_LAZY);
+        char buffer[1000];
+        jsJSON_serializeToStr(root, buffer, sizeof(buffer));
+        printf("match: %s\n", buffer);
+        ok = ok && strcmp(jsJSON_getString(root, "sender"), "Alice") == 0
+                && jsJSON_getNumber(jsJSON_getObject(root, "payload"), "priority") > 2;
+        jsJSON_free(root);
+    }
+
+    // scanning can be continued when the matches array runs full
+    count = jsJSON_filterLines(filters, 1, log, strlen(log), true, matches, 1, &consumed);
+    ok = ok && count == 1 && matches[0].start == log + consumed - matches[0].length - 1;
+
+    // a key that no record has
+    filters[0].path = "payload.missing";
+    filters[0].op = jsJSON_FILTER_EXISTS;
+    ok = ok && jsJSON_filterLines(filters, 1, log, strlen(log), true, matches, 8, NULL) == 0;
+
+    // a stream arrives in chunks and records may cross chunk boundaries.
+    // The unterminated tail of a chunk is left for the next call.
+    filters[0].path = "sender";
+    filters[0].op = jsJSON_FILTER_STRING_EQUALS;
+    size_t split = strlen(log) - 20;
+    count = jsJSON_filterLines(filters, 2, log, split, false, matches, 8, &consumed);
+    ok = ok && count == 1 && consumed < split;
+    count = jsJSON_filterLines(filters, 2, log + consumed, strlen(log) - consumed, true, matches, 8, NULL);
+    ok = ok && count == 1 && matches[0].start[matches[0].length - 1] == '}';
+
+    // without filters every record matches, but blank lines do not
+    char* sparse = "{\"a\":1}\n\n{\"b\":2}\n  \r\n{\"c\":3}\n";
+    ok = ok && jsJSON_filterLines(filters, 0, sparse, strlen(sparse), true, matches, 8, NULL) == 3;
+
+    if( !ok ) {
+        printf("filtered records do not match\n");
+        return 1;
+    }
+    return 0;
+}
+
@@ -0,0 +1,65 @@
+#include "../jsJSON.h" 
+#include <stdio.h>
+#include <stdlib.h> // malloc(), free()
+#include <string.h> // strcmp()
+#include <stdbool.h> // bool
+#include <stdint.h> // uint64_t
+
+int main() {
+    // a GeoJSON point. With jsJSON_PARSE_PACK_NUMBERS the coordinates
+    // end up in one contiguous double array instead of one node each
+    char* json = "{\"type\":\"Point\",\"coordinates\":[-122.4194, 37.7749, 1.5e1],\"tags\":[1, \"two\", 3],\"bbox\":[]}";
+    printf("%s\n", json);
+    jsJSON* root = jsJSON_parseWithFlags(json, jsJSON_PARSE_PACK_NUMBERS);
+
+    size_t length = 0;
+    const double* coordinates = jsJSON_getNumberArray(root, "coordinates", &length);
+    for( size_t i = 0; i < length; i++ ) {
+        printf("coordinate %zu: %f\n", i, coordinates[i]);
+    }
+
+    // mixed arrays are stored as usual
+    size_t tagsLength = 0;
+    const double* tags = jsJSON_getNumberArray(root, "tags", &tagsLength);
+
+    // an empty array is packed as well, it is just empty
+    size_t bboxLength = 1;
+    const double* bbox = jsJSON_getNumberArray(root, "bbox", &bboxLength);
+
+    bool ok = coordinates != NULL
+           && bbox != NULL
+           && bboxLength == 0
+           && length == 3
+           && coordinates[0] == -122.4194
+           && coordinates[2] == 15
+           && tags == NULL
+           && jsJSON_getObject(root, "tags")->children != NULL;
+
+    // number arrays can be built directly too
+    double samples[] = { 0.5, 1.5, 2.5, 3.5 };
+    jsJSON* telemetry = jsJSON_newObject(NULL);
+    jsJSON_addNumberArray(telemetry, "samples", samples, 4);
+
+    char buffer[1000];
+    jsJSON_serializeToStr(telemetry, buffer, sizeof(buffer));
+    printf("%s\n", buffer);
+    ok = ok && strcmp(buffer, "{\"samples\": [0.500000, 1.500000, 2.500000, 3.500000]}") == 0;
+
+    // adding something else unpacks the array again
+    jsJSON* samplesNode = jsJSON_getObject(telemetry, "samples");
+    jsJSON_addString(samplesNode, NULL, "done");
+    jsJSON_serializeToStr(telemetry, buffer, sizeof(buffer));
+    printf("%s\n", buffer);
+    ok = ok && !samplesNode->isPacked
+            && strcmp(buffer, "{\"samples\": [0.500000, 1.500000, 2.500000, 3.500000, \"done\"]}") == 0;
+
+    jsJSON_free(root);
+    jsJSON_free(telemetry);
+
+    if( !ok ) {
+        printf("packed number arrays do not match\n");
+        return 1;
+    }
+    return 0;
+}
+
@@ -14,9 +14,13 @@ jsJSON* jsJSON_new(enum jsJSON_TYPE type, const char *key) {
     } else {
         json->key = NULL;
     }
+    json->isPending = false;
+    json->isPacked = false;
+    // clears the whole value union, including children
     json->numberValue = 0;
     json->stringValue = NULL;
-    json->children = NULL;
+    json->cache = NULL;
+    json->parent = NULL;
     json->sibblings = NULL;
     return json;
 }
@@ -29,6 +33,24 @@ jsJSON* jsJSON_newArray(const char *key) {
     return jsJSON_new(jsJSON_TYPE_ARRAY, key);
 }
 
+// allocates at least one element so that an empty packed array
+// still has a non NULL numberArray and can be told apart from
+// an array that is not packed
+static double* jsJSON_allocNumberArray(size_t length) {
+    return malloc((length > 0 ? length : 1) * sizeof(double));
+}
+
+jsJSON* jsJSON_newNumberArray(const char *key, const double *values, size_t length) {
+    jsJSON* n = jsJSON_new(jsJSON_TYPE_ARRAY, key);
+    n->isPacked = true;
+    n->numberArray = jsJSON_allocNumberArray(length);
+    if( length > 0 ) {
+        memcpy(n->numberArray, values, length * sizeof(double));
+    }
+    n->numberArrayLength = length;
+    return n;
+}
+
 jsJSON* jsJSON_newString(const char *key, const char *value) {
     jsJSON* n = jsJSON_new(jsJSON_TYPE_STRING, key);
     if( value != NULL ) {
@@ -51,8 +73,120 @@ jsJSON* jsJSON_newBool(const char *key, bool value) {
     return n;
 }
 
+static char* jsJSON_strndup(const char* src, size_t length) {
+    char *dst = malloc(length + 1);
+    if (dst == NULL) return NULL;
+    memcpy(dst, src, length);
+    dst[length] = '\0';
+    return dst;
+}
+
+// converts a number that is not null terminated. Short numbers are
+// copied to the stack, longer ones to the heap, but never truncated.
+static double jsJSON_spanToNumber(const char* src, size_t length) {
+    char number[64];
+    if( length < sizeof(number) ) {
+        memcpy(number, src, length);
+        number[length] = '\0';
+        return atof(number);
+    }
+    char* copy = jsJSON_strndup(src, length);
+    double value = atof(copy);
+    free(copy);
+    return value;
+}
+
+// converts the raw token span of a lazily parsed node into its value and
+// caches it in the node. Caching does not change the logical value of the
+// node, which is why this is allowed on const nodes.
+static void jsJSON_materialize(const jsJSON* node) {
+    if( !node->isPending ) return;
+    jsJSON* n = (jsJSON*)node;
+    // the span shares its storage with the values, so it
+    // has to be converted completely before they are set
+    char* stringValue = NULL;
+    double numberValue = 0;
+    if( n->type == jsJSON_TYPE_STRING ) {
+        stringValue = jsJSON_strndup(n->raw, n->rawLength);
+    } else {
+        numberValue = jsJSON_spanToNumber(n->raw, n->rawLength);
+    }
+    n->numberValue = numberValue;
+    n->stringValue = stringValue;
+    n->isPending = false;
+}
+
+double jsJSON_numberValue(const jsJSON* node) {
+    // the value storage of other nodes holds something else
+    if( node->type != jsJSON_TYPE_NUMBER ) return 0;
+    jsJSON_materialize(node);
+    return node->numberValue;
+}
+
+char* jsJSON_stringValue(const jsJSON* node) {
+    if( node->type != jsJSON_TYPE_STRING ) return NULL;
+    jsJSON_materialize(node);
+    return node->stringValue;
+}
+
+void jsJSON_markDirty(jsJSON* node) {
+    // every ancestor embeds the serialization of this node and
+    // thus has to drop its cached bytes as well. Caches above a
+    // dirty cache are always dirty too, so the walk stops there.
+    while( node != NULL ) {
+        if( node->cache != NULL ) {
+            if( node->cache->isDirty ) return;
+            node->cache->isDirty = true;
+        }
+        node = node->parent;
+    }
+}
+
+void jsJSON_setCacheable(jsJSON* node, bool cacheable) {
+    if( cacheable && node->cache == NULL ) {
+        // the cache is filled by the next serialization
+        node->cache = malloc(sizeof(jsJSON_Cache));
+        node->cache->isDirty = false;
+        node->cache->bytes = NULL;
+        node->cache->length = 0;
+    } else if( !cacheable && node->cache != NULL ) {
+        free(node->cache->bytes);
+        free(node->cache);
+        node->cache = NULL;
+    }
+}
+
+// turns the numbers of a packed array back into child nodes, which is
+// necessary as soon as anything else is added to the array
+static void jsJSON_unpackNumberArray(jsJSON* array) {
+    double* values = array->numberArray;
+    size_t length = array->numberArrayLength;
+    array->isPacked = false;
+    array->numberArrayLength = 0;
+    array->children = NULL;
+    // a packed array has no children, so the list is linked right here
+    // instead of walking it in jsJSON_add() for every number. Marking
+    // the array dirty is left to the jsJSON_add() call that unpacks.
+    jsJSON* last = NULL;
+    for( size_t i = 0; i < length; i++ ) {
+        jsJSON* child = jsJSON_newNumber(NULL, values[i]);
+        child->parent = array;
+        if( last == NULL ) {
+            array->children = child;
+        } else {
+            last->sibblings = child;
+        }
+        last = child;
+    }
+    free(values);
+}
+
 jsJSON* jsJSON_add(jsJSON* parent, jsJSON* child) {
 
+    if (parent->isPacked) {
+        jsJSON_unpackNumberArray(parent);
+    }
+
     // children are stored in a linked list
     // thus, if the parent has no children yet, this child
     // iniatiates the linked list
@@ -67,6 +201,8 @@ jsJSON* jsJSON_add(jsJSON* parent, jsJSON* child) {
         }
         last->sibblings = child;
     }
+    child->parent = parent;
+    jsJSON_markDirty(parent);
     return child;
 }
 
@@ -91,13 +227,19 @@ jsJSON* jsJSON_addNumber(jsJSON* parent, const char *key, double value) {
     return jsJSON_add(parent, jsJSON_newNumber(key, value));
 }
 
+jsJSON* jsJSON_addNumberArray(jsJSON* parent, const char *key, const double *values, size_t length) {
+    return jsJSON_add(parent, jsJSON_newNumberArray(key, values, length));
+}
+
 void write(char* buffer, const char* str, size_t bufferSize, size_t *bytesWritten) {
     //printf("write: [%s], bufferSize: %llu, bytesWritten: %llu\n", str, bufferSize - *bytesWritten, *bytesWritten);
     int count = snprintf((char*)((size_t)buffer + (size_t)(*bytesWritten)), bufferSize - *bytesWritten, "%s", str);
     *bytesWritten += count;
 }
 
-static void jsJSON_serializeToStrRecursive(const jsJSON* root, char *buffer, size_t bufferSize, size_t *bytesWritten) {
+static void jsJSON_serializeToStrRecursive(const jsJSON* root, char *buffer, size_t bufferSize, size_t *bytesWritten);
+
+static void jsJSON_serializeValueToStr(const jsJSON* root, char *buffer, size_t bufferSize, size_t *bytesWritten) {
     if (root->type == jsJSON_TYPE_OBJECT) {
         write(buffer, "{", bufferSize, bytesWritten);
         jsJSON* child = root->children;
@@ -114,7 +256,15 @@ static void jsJSON_serializeToStrRecursive(const jsJSON* root, char *buffer, siz
         write(buffer, "}", bufferSize, bytesWritten);
     } else if (root->type == jsJSON_TYPE_ARRAY) {
         write(buffer, "[", bufferSize, bytesWritten);
-        jsJSON* child = root->children;
+        size_t packed = root->isPacked ? root->numberArrayLength : 0;
+        for( size_t i = 0; i < packed; i++ ) {
+            int count = snprintf(
+                (char*)((size_t)buffer + (size_t)(*bytesWritten)), 
+                bufferSize - *bytesWritten, 
+                i + 1 < packed ? "%f, " : "%f", root->numberArray[i]);
+            *bytesWritten += count;
+        }
+        jsJSON* child = root->isPacked ? NULL : root->children;
         while( child != NULL ) {
             jsJSON_serializeToStrRecursive(child, buffer, bufferSize, bytesWritten);
             if( child->sibblings != NULL ) {
@@ -127,13 +277,13 @@ static void jsJSON_serializeToStrRecursive(const jsJSON* root, char *buffer, siz
         int count = snprintf(
             (char*)((size_t)buffer + (size_t)(*bytesWritten)), 
             bufferSize - *bytesWritten, 
-            "\"%s\"", root->stringValue);
+            "\"%s\"", jsJSON_stringValue(root));
         *bytesWritten += count;
     } else if (root->type == jsJSON_TYPE_NUMBER) {
         int count = snprintf(
             (char*)((size_t)buffer + (size_t)(*bytesWritten)), 
             bufferSize - *bytesWritten, 
-            "%f", root->numberValue);
+            "%f", jsJSON_numberValue(root));
         *bytesWritten += count;
     } else if (root->type == jsJSON_TYPE_BOOL) {
         if (root->boolValue) {
@@ -144,6 +294,35 @@ static void jsJSON_serializeToStrRecursive(const jsJSON* root, char *buffer, siz
     }
 }
 
+// stores the serialized bytes of a cacheable node and takes ownership of them
+static void jsJSON_storeCache(const jsJSON* node, char* bytes, size_t length) {
+    free(node->cache->bytes);
+    node->cache->bytes = bytes;
+    node->cache->length = length;
+    node->cache->isDirty = false;
+}
+
+static bool jsJSON_isCached(const jsJSON* node) {
+    return node->cache != NULL && !node->cache->isDirty && node->cache->bytes != NULL;
+}
+
+static void jsJSON_serializeToStrRecursive(const jsJSON* root, char *buffer, size_t bufferSize, size_t *bytesWritten) {
+    if( root->cache == NULL ) {
+        jsJSON_serializeValueToStr(root, buffer, bufferSize, bytesWritten);
+        return;
+    }
+    if( jsJSON_isCached(root) ) {
+        write(buffer, root->cache->bytes, bufferSize, bytesWritten);
+        return;
+    }
+    size_t start = *bytesWritten;
+    jsJSON_serializeValueToStr(root, buffer, bufferSize, bytesWritten);
+    // only cache complete output, not what was cut off at the end of the buffer
+    if( *bytesWritten < bufferSize ) {
+        jsJSON_storeCache(root, jsJSON_strndup(buffer + start, *bytesWritten - start), *bytesWritten - start);
+    }
+}
+
 size_t jsJSON_serializeToStr(const jsJSON* root, char *buffer, size_t bufferSize) {
     size_t bytesWritten = 0;
 
@@ -153,6 +332,189 @@ size_t jsJSON_serializeToStr(const jsJSON* root, char *buffer, size_t bufferSize
     return bytesWritten;
 }
 
+typedef struct jsJSON_IovecWriter {
+    jsJSON_iovec* iov;
+    size_t iovCount;
+    size_t iovUsed;
+    char* scratch;
+    size_t scratchSize;
+    size_t scratchUsed;
+    size_t referenceThreshold;
+    bool overflow;
+} jsJSON_IovecWriter;
+
+static void jsJSON_IovecWriter_push(jsJSON_IovecWriter* writer, const char* base, size_t length) {
+    if( writer->overflow || length == 0 ) return;
+    if( writer->iovUsed == writer->iovCount ) {
+        writer->overflow = true;
+        return;
+    }
+    writer->iov[writer->iovUsed].base = base;
+    writer->iov[writer->iovUsed].length = length;
+    writer->iovUsed++;
+}
+
+// registers the next length bytes of the scratch buffer as output. If the
+// previous entry ends right where these bytes start, it is simply extended
+// so that consecutive structural bytes end up in a single entry.
+static void jsJSON_IovecWriter_commit(jsJSON_IovecWriter* writer, size_t length) {
+    char* start = writer->scratch + writer->scratchUsed;
+    writer->scratchUsed += length;
+    if( writer->iovUsed > 0 ) {
+        jsJSON_iovec* last = &writer->iov[writer->iovUsed - 1];
+        if( (const char*)last->base + last->length == start ) {
+            last->length += length;
+            return;
+        }
+    }
+    jsJSON_IovecWriter_push(writer, start, length);
+}
+
+static void jsJSON_IovecWriter_copy(jsJSON_IovecWriter* writer, const char* str, size_t length) {
+    if( writer->overflow ) return;
+    if( writer->scratchSize - writer->scratchUsed < length ) {
+        writer->overflow = true;
+        return;
+    }
+    memcpy(writer->scratch + writer->scratchUsed, str, length);
+    jsJSON_IovecWriter_commit(writer, length);
+}
+
+static void jsJSON_IovecWriter_write(jsJSON_IovecWriter* writer, const char* str) {
+    jsJSON_IovecWriter_copy(writer, str, strlen(str));
+}
+
+static void jsJSON_IovecWriter_number(jsJSON_IovecWriter* writer, double value) {
+    if( writer->overflow ) return;
+    size_t available = writer->scratchSize - writer->scratchUsed;
+    int count = snprintf(writer->scratch + writer->scratchUsed, available, "%f", value);
+    if( count < 0 || (size_t)count >= available ) {
+        writer->overflow = true;
+        return;
+    }
+    jsJSON_IovecWriter_commit(writer, (size_t)count);
+}
+
+static void jsJSON_serializeToIovecRecursive(const jsJSON* root, jsJSON_IovecWriter* writer);
+
+static void jsJSON_serializeValueToIovec(const jsJSON* root, jsJSON_IovecWriter* writer) {
+    if (root->type == jsJSON_TYPE_OBJECT) {
+        jsJSON_IovecWriter_write(writer, "{");
+        jsJSON* child = root->children;
+        while( child != NULL ) {
+            jsJSON_IovecWriter_write(writer, "\"");
+            jsJSON_IovecWriter_write(writer, child->key);
+            jsJSON_IovecWriter_write(writer, "\": ");
+            jsJSON_serializeToIovecRecursive(child, writer);
+            if( child->sibblings != NULL ) {
+                jsJSON_IovecWriter_write(writer, ", ");
+            }
+            child = child->sibblings;
+        }
+        jsJSON_IovecWriter_write(writer, "}");
+    } else if (root->type == jsJSON_TYPE_ARRAY) {
+        jsJSON_IovecWriter_write(writer, "[");
+        size_t packed = root->isPacked ? root->numberArrayLength : 0;
+        for( size_t i = 0; i < packed; i++ ) {
+            jsJSON_IovecWriter_number(writer, root->numberArray[i]);
+            if( i + 1 < packed ) {
+                jsJSON_IovecWriter_write(writer, ", ");
+            }
+        }
+        jsJSON* child = root->isPacked ? NULL : root->children;
+        while( child != NULL ) {
+            jsJSON_serializeToIovecRecursive(child, writer);
+            if( child->sibblings != NULL ) {
+                jsJSON_IovecWriter_write(writer, ", ");
+            }
+            child = child->sibblings;
+        }
+        jsJSON_IovecWriter_write(writer, "]");
+    } else if (root->type == jsJSON_TYPE_STRING) {
+        // escapes are never decoded, so the raw span of a pending string
+        // is exactly its output and does not need to be converted first
+        const char* value = root->isPending ? root->raw : root->stringValue;
+        size_t length = root->isPending ? root->rawLength : strlen(root->stringValue);
+        jsJSON_IovecWriter_write(writer, "\"");
+        if( length >= writer->referenceThreshold ) {
+            // large values are handed out by reference, this is
+            // the whole point of the vectored serialization
+            jsJSON_IovecWriter_push(writer, value, length);
+        } else {
+            jsJSON_IovecWriter_copy(writer, value, length);
+        }
+        jsJSON_IovecWriter_write(writer, "\"");
+    } else if (root->type == jsJSON_TYPE_NUMBER) {
+        jsJSON_IovecWriter_number(writer, jsJSON_numberValue(root));
+    } else if (root->type == jsJSON_TYPE_BOOL) {
+        if (root->boolValue) {
+            jsJSON_IovecWriter_write(writer, "true");
+        } else {
+            jsJSON_IovecWriter_write(writer, "false");
+        }
+    }
+}
+
+static void jsJSON_serializeToIovecRecursive(const jsJSON* root, jsJSON_IovecWriter* writer) {
+    if( root->cache == NULL ) {
+        jsJSON_serializeValueToIovec(root, writer);
+        return;
+    }
+    if( jsJSON_isCached(root) ) {
+        // cached bytes are stable until the next mutation, so they
+        // can be referenced just like large string values
+        jsJSON_IovecWriter_push(writer, root->cache->bytes, root->cache->length);
+        return;
+    }
+
+    // the bytes of this node start at the end of the current last entry,
+    // which may be extended, and continue through all entries added below
+    size_t first = writer->iovUsed;
+    size_t offset = first > 0 ? writer->iov[first - 1].length : 0;
+    jsJSON_serializeValueToIovec(root, writer);
+    if( writer->overflow ) return;
+
+    size_t length = 0;
+    if( first > 0 ) {
+        length += writer->iov[first - 1].length - offset;
+    }
+    for( size_t i = first; i < writer->iovUsed; i++ ) {
+        length += writer->iov[i].length;
+    }
+    char* bytes = malloc(length + 1);
+    size_t copied = 0;
+    if( first > 0 ) {
+        const jsJSON_iovec* extended = &writer->iov[first - 1];
+        memcpy(bytes, (const char*)extended->base + offset, extended->length - offset);
+        copied += extended->length - offset;
+    }
+    for( size_t i = first; i < writer->iovUsed; i++ ) {
+        memcpy(bytes + copied, writer->iov[i].base, writer->iov[i].length);
+        copied += writer->iov[i].length;
+    }
+    bytes[length] = '\0';
+    jsJSON_storeCache(root, bytes, length);
+}
+
+size_t jsJSON_serializeToIovec(const jsJSON* root, jsJSON_iovec* iov, size_t iovCount, char* scratch, size_t scratchSize, size_t referenceThreshold) {
+    jsJSON_IovecWriter writer;
+    writer.iov = iov;
+    writer.iovCount = iovCount;
+    writer.iovUsed = 0;
+    writer.scratch = scratch;
+    writer.scratchSize = scratchSize;
+    writer.scratchUsed = 0;
+    writer.referenceThreshold = referenceThreshold;
+    writer.overflow = false;
+
+    jsJSON_serializeToIovecRecursive(root, &writer);
+
+    if( writer.overflow ) {
+        return 0;
+    }
+    return writer.iovUsed;
+}
+
 enum jsJSON_TokenType {
     jsJSON_TokenType_SINGLE_CHAR,
     jsJSON_TokenType_STRING,
@@ -167,23 +529,32 @@ typedef struct jsJSON_Tokenizer {
     size_t line;
     size_t column;
     size_t jsonLength;
+    // copy of the current token for matching and error messages,
+    // long strings are truncated here. The full token is described
+    // by tokenStart and tokenLength, which point into json.
     char token[500];
+    size_t tokenStart;
+    size_t tokenLength;
     //char* last;
     bool isEOF;
     enum jsJSON_TokenType tokenType;
+    unsigned flags;
 } jsJSON_Tokenizer;
 
-static jsJSON_Tokenizer jsJSON_Tokenizer_new(const char* json) {
+static jsJSON_Tokenizer jsJSON_Tokenizer_new(const char* json, size_t length, unsigned flags) {
     jsJSON_Tokenizer tokenizer;
     tokenizer.json = json;
     tokenizer.index = 0;
     tokenizer.line = 1;
     tokenizer.column = 1;
-    tokenizer.jsonLength = strlen(json);
+    tokenizer.jsonLength = length;
     tokenizer.token[0] = '\0';
+    tokenizer.tokenStart = 0;
+    tokenizer.tokenLength = 0;
     //tokenizer.last = NULL;
     tokenizer.isEOF = false;
     tokenizer.tokenType = jsJSON_TokenType_NULL_VALUE;
+    tokenizer.flags = flags;
     return tokenizer;
 }
 
@@ -205,11 +576,17 @@ static void jsJSON_Tokenizer_next(jsJSON_Tokenizer* tokenizer) {
             tokenizer->tokenType = jsJSON_TokenType_SINGLE_CHAR;
             return;
         } else if( c == '"' ) {
-            int counter = 0;
-            while( tokenizer->json[tokenizer->index] != '"' ) {
-                tokenizer->token[counter++] = tokenizer->json[tokenizer->index++];
+            size_t counter = 0;
+            tokenizer->tokenStart = tokenizer->index;
+            while( tokenizer->index < tokenizer->jsonLength
+                && tokenizer->json[tokenizer->index] != '"' ) {
+                if( counter < sizeof(tokenizer->token) - 1 ) {
+                    tokenizer->token[counter++] = tokenizer->json[tokenizer->index];
+                }
+                tokenizer->index++;
             }
-            tokenizer->token[counter++] = '\0';
+            tokenizer->token[counter] = '\0';
+            tokenizer->tokenLength = tokenizer->index - tokenizer->tokenStart;
             tokenizer->index++; // jump over the last quote
             tokenizer->tokenType = jsJSON_TokenType_STRING;
             return;
@@ -218,19 +595,29 @@ static void jsJSON_Tokenizer_next(jsJSON_Tokenizer* tokenizer) {
                 tokenizer->line++;
                 tokenizer->column = 1;
             }
-        } else if( c >= 48 && c <= 57 ) { // number
-            int counter = 0;
+        } else if( (c >= 48 && c <= 57) || c == '-' ) { // number
+            size_t counter = 0;
+            tokenizer->tokenStart = tokenizer->index - 1;
             tokenizer->token[counter++] = c;
-            while( (tokenizer->json[tokenizer->index] >= 48 
+            while( tokenizer->index < tokenizer->jsonLength
+                && ((tokenizer->json[tokenizer->index] >= 48 
                  && tokenizer->json[tokenizer->index] <= 57) 
-                 || tokenizer->json[tokenizer->index] == '.') {
-                tokenizer->token[counter++] = tokenizer->json[tokenizer->index++];
+                 || tokenizer->json[tokenizer->index] == '.'
+                 || tokenizer->json[tokenizer->index] == 'e'
+                 || tokenizer->json[tokenizer->index] == 'E'
+                 || tokenizer->json[tokenizer->index] == '+'
+                 || tokenizer->json[tokenizer->index] == '-') ) {
+                if( counter < sizeof(tokenizer->token) - 1 ) {
+                    tokenizer->token[counter++] = tokenizer->json[tokenizer->index];
+                }
+                tokenizer->index++;
             }
-            tokenizer->token[counter++] = '\0';
+            tokenizer->token[counter] = '\0';
+            tokenizer->tokenLength = tokenizer->index - tokenizer->tokenStart;
             tokenizer->tokenType = jsJSON_TokenType_NUMBER;
             //cout << "found number [" << token << "] " << index << endl;
             return;
-        } else if( c == 't' && strlen(tokenizer->json) > tokenizer->index + 3 ) { // boolean, true
+        } else if( c == 't' && tokenizer->jsonLength > tokenizer->index + 3 ) { // boolean, true
             tokenizer->token[0] = 't';
             tokenizer->token[1] = 'r';
             tokenizer->token[2] = 'u';
@@ -240,7 +627,7 @@ static void jsJSON_Tokenizer_next(jsJSON_Tokenizer* tokenizer) {
             tokenizer->tokenType = jsJSON_TokenType_BOOLEAN;
             //cout << "found true [" << token << "] " << index << endl;
             return;
-        } else if( c == 'f' && strlen(tokenizer->json) > tokenizer->index + 4 ) { // boolean, false
+        } else if( c == 'f' && tokenizer->jsonLength > tokenizer->index + 4 ) { // boolean, false
             tokenizer->token[0] = 'f';
             tokenizer->token[1] = 'a';
             tokenizer->token[2] = 'l';
@@ -288,31 +675,66 @@ char *jsJSON_strdup(const char *src) {
 
 static jsJSON* jsJSON_parseArray(jsJSON_Tokenizer* tokenizer, const char *key);
 
+// creates a string or number node from the current token. In lazy mode the node
+// only remembers where the token is in the input and converts it on first access.
+static jsJSON* jsJSON_parseValue(jsJSON_Tokenizer* tokenizer, const char *key) {
+    enum jsJSON_TYPE type = tokenizer->tokenType == jsJSON_TokenType_STRING ? jsJSON_TYPE_STRING : jsJSON_TYPE_NUMBER;
+    jsJSON* node = jsJSON_new(type, key);
+    node->raw = tokenizer->json + tokenizer->tokenStart;
+    node->rawLength = tokenizer->tokenLength;
+    node->isPending = true;
+    if( (tokenizer->flags & jsJSON_PARSE_LAZY) == 0 ) {
+        jsJSON_materialize(node);
+    }
+    return node;
+}
+
+// appends a freshly parsed child behind last. Unlike jsJSON_add() this neither
+// walks the children list nor marks anything dirty, a tree that is still being
+// parsed has no caches.
+static void jsJSON_parseLink(jsJSON* parent, jsJSON** last, jsJSON* child) {
+    if( parent->isPacked ) {
+        // not a number array after all
+        jsJSON_unpackNumberArray(parent);
+        *last = parent->children;
+        while( *last != NULL && (*last)->sibblings != NULL ) {
+            *last = (*last)->sibblings;
+        }
+    }
+    if( *last == NULL ) {
+        parent->children = child;
+    } else {
+        (*last)->sibblings = child;
+    }
+    *last = child;
+    child->parent = parent;
+}
+
 static jsJSON* jsJSON_parseObject(jsJSON_Tokenizer* tokenizer, const char *key) {
     jsJSON* root = jsJSON_newObject(key);
+    jsJSON* last = NULL;
     jsJSON_Tokenizer_next(tokenizer);
     //printf("jsJSON_parseObject(): going into while loop [%s]\n", tokenizer->token);
     while( tokenizer->token[0] != '}' ) {
         jsJSON_Tokenizer_expectType(tokenizer, jsJSON_TokenType_STRING);
         // we need to duplicate the string because the tokenizer
         // will overwrite the token on the next call to next()
-        char* name = jsJSON_strdup(tokenizer->token);
+        char* name = jsJSON_strndup(tokenizer->json + tokenizer->tokenStart, tokenizer->tokenLength);
         //printf("   name [%s]\n", name);
         jsJSON_Tokenizer_nextExpectChar(tokenizer, ':'); // jump over string to colon
         jsJSON_Tokenizer_next(tokenizer); // jump over colon
         //printf("jsJSON_parseObject(): matching against [%s] with key [%s]\n", tokenizer->token, name);
         if( tokenizer->token[0] == '{' ) {
             jsJSON* child = jsJSON_parseObject(tokenizer, name);
-            jsJSON_add(root, child);
+            jsJSON_parseLink(root, &last, child);
         } else if( tokenizer->token[0] == '[' ) {
             jsJSON* child = jsJSON_parseArray(tokenizer, name);
-            jsJSON_add(root, child);
-        } else if( tokenizer->tokenType == jsJSON_TokenType_STRING ) {
-            jsJSON_addString(root, name, tokenizer->token);
-        } else if( tokenizer->tokenType == jsJSON_TokenType_NUMBER ) {
-            jsJSON_addNumber(root, name, atof(tokenizer->token));
+            jsJSON_parseLink(root, &last, child);
+        } else if( tokenizer->tokenType == jsJSON_TokenType_STRING
+                || tokenizer->tokenType == jsJSON_TokenType_NUMBER ) {
+            jsJSON_parseLink(root, &last, jsJSON_parseValue(tokenizer, name));
         } else if( tokenizer->tokenType == jsJSON_TokenType_BOOLEAN ) {
-            jsJSON_addBoolean(root, name, tokenizer->token[0] == 't');
+            jsJSON_parseLink(root, &last, jsJSON_newBool(name, tokenizer->token[0] == 't'));
         } else {
             printf("Error: unexpected token [%s]\n", tokenizer->token);
             exit(1);
@@ -330,21 +752,44 @@ static jsJSON* jsJSON_parseObject(jsJSON_Tokenizer* tokenizer, const char *key)
 
 static jsJSON* jsJSON_parseArray(jsJSON_Tokenizer* tokenizer, const char *key) {
     jsJSON* root = jsJSON_newArray(key);
+    jsJSON* last = NULL;
+
+    // as long as the array holds only numbers, they are collected in a
+    // contiguous buffer instead of one node per number
+    bool pack = (tokenizer->flags & jsJSON_PARSE_PACK_NUMBERS) != 0;
+    size_t capacity = 0;
+
     jsJSON_Tokenizer_next(tokenizer);
     while( tokenizer->token[0] != ']' ) {
         //printf("jsJSON_parseArray(): matching against [%s]\n", tokenizer->token);
+        if( pack && tokenizer->tokenType == jsJSON_TokenType_NUMBER ) {
+            if( root->numberArrayLength == capacity ) {
+                // coordinate pairs and triples are the common case, so start small
+                capacity = capacity == 0 ? 4 : capacity * 2;
+                root->numberArray = realloc(root->numberArray, capacity * sizeof(double));
+                root->isPacked = true;
+            }
+            root->numberArray[root->numberArrayLength++] = jsJSON_spanToNumber(tokenizer->json + tokenizer->tokenStart, tokenizer->tokenLength);
+            jsJSON_Tokenizer_nextExpectTwoOptions(tokenizer, ',', ']');
+            if( tokenizer->token[0] == ',' ) {
+                jsJSON_Tokenizer_next(tokenizer);
+            }
+            continue;
+        }
+        // not a number array after all, jsJSON_parseLink() unpacks
+        // the numbers collected so far
+        pack = false;
         if( tokenizer->token[0] == '{' ) {
             jsJSON* child = jsJSON_parseObject(tokenizer, NULL);
-            jsJSON_add(root, child);
+            jsJSON_parseLink(root, &last, child);
         } else if( tokenizer->token[0] == '[' ) {
             jsJSON* child = jsJSON_parseArray(tokenizer, NULL);
-            jsJSON_add(root, child);
-        } else if( tokenizer->tokenType == jsJSON_TokenType_STRING ) {
-            jsJSON_addString(root, NULL, jsJSON_strdup(tokenizer->token));
-        } else if( tokenizer->tokenType == jsJSON_TokenType_NUMBER ) {
-            jsJSON_addNumber(root, NULL, atof(tokenizer->token));
+            jsJSON_parseLink(root, &last, child);
+        } else if( tokenizer->tokenType == jsJSON_TokenType_STRING
+                || tokenizer->tokenType == jsJSON_TokenType_NUMBER ) {
+            jsJSON_parseLink(root, &last, jsJSON_parseValue(tokenizer, NULL));
         } else if( tokenizer->tokenType == jsJSON_TokenType_BOOLEAN ) {
-            jsJSON_addBoolean(root, NULL, tokenizer->token[0] == 't');
+            jsJSON_parseLink(root, &last, jsJSON_newBool(NULL, tokenizer->token[0] == 't'));
         } else {
             printf("Error: unexpected token [%s]\n", tokenizer->token);
             exit(1);
@@ -354,6 +799,14 @@ static jsJSON* jsJSON_parseArray(jsJSON_Tokenizer* tokenizer, const char *key) {
             jsJSON_Tokenizer_next(tokenizer);
         }
     }
+    if( pack && !root->isPacked ) {
+        // an empty array is a packed number array, too
+        root->numberArray = jsJSON_allocNumberArray(0);
+        root->isPacked = true;
+    } else if( pack && root->numberArrayLength < capacity ) {
+        // give back what the doubling reserved beyond the last number
+        root->numberArray = realloc(root->numberArray, root->numberArrayLength * sizeof(double));
+    }
     return root;
 }
 
@@ -363,7 +816,15 @@ static jsJSON* jsJSON_parseArray(jsJSON_Tokenizer* tokenizer, const char *key) {
  * into its own memory so that the original JSON string can be freed.
 */
 jsJSON* jsJSON_parse(const char *json) {
-    jsJSON_Tokenizer tokenizer = jsJSON_Tokenizer_new(json);
+    return jsJSON_parseWithFlags(json, jsJSON_PARSE_DEFAULT);
+}
+
+jsJSON* jsJSON_parseWithFlags(const char *json, unsigned flags) {
+    return jsJSON_parseWithLength(json, strlen(json), flags);
+}
+
+jsJSON* jsJSON_parseWithLength(const char *json, size_t length, unsigned flags) {
+    jsJSON_Tokenizer tokenizer = jsJSON_Tokenizer_new(json, length, flags);
     jsJSON_Tokenizer_next(&tokenizer);
     //printf("starting: %s\n", tokenizer.token);
     if( tokenizer.token[0] == '{' ) {
@@ -385,10 +846,13 @@ jsJSON* jsJSON_parse(const char *json) {
 void jsJSON_free(jsJSON *root) {
     if( root == NULL ) return;
 
-    if (root->type == jsJSON_TYPE_STRING) {
+    if (root->type == jsJSON_TYPE_STRING && !root->isPending) {
         free(root->stringValue);
     }
-    if (root->type == jsJSON_TYPE_OBJECT || root->type == jsJSON_TYPE_ARRAY) {
+    jsJSON_setCacheable(root, false);
+    if (root->isPacked) {
+        free(root->numberArray);
+    } else if (root->type == jsJSON_TYPE_OBJECT || root->type == jsJSON_TYPE_ARRAY) {
         jsJSON* child = root->children;
         while( child != NULL ) {
             jsJSON* next = child->sibblings;
@@ -406,7 +870,7 @@ char*  jsJSON_getString(const jsJSON* root, const char* key) {
     jsJSON* child = root->children;
     while( child != NULL ) {
         if( strcmp(child->key, key) == 0 ) {
-            return child->stringValue;
+            return jsJSON_stringValue(child);
         }
         child = child->sibblings;
     }
@@ -420,7 +884,7 @@ double jsJSON_getNumber(const jsJSON* root, const char* key) {
     jsJSON* child = root->children;
     while( child != NULL ) {
         if( strcmp(child->key, key) == 0 ) {
-            return child->numberValue;
+            return jsJSON_numberValue(child);
         }
         child = child->sibblings;
     }
@@ -456,17 +920,26 @@ jsJSON* jsJSON_getObject(const jsJSON* root, const char* key) {
 }
 
 jsJSON* jsJSON_duplicate(const jsJSON* root) {
+    // the duplicate must not depend on the input of a lazy parse
+    jsJSON_materialize(root);
+
     // note, jsJSON_new duplicates the key string
     jsJSON* newRoot = jsJSON_new(root->type, root->key);
     newRoot->boolValue   = root->boolValue;
-    newRoot->numberValue = root->numberValue;
+    jsJSON_setCacheable(newRoot, root->cache != NULL);
 
-    if( root->stringValue != NULL ) {
+    // which values are set depends on the type, see the union in jsJSON
+    if( root->type == jsJSON_TYPE_NUMBER ) {
+        newRoot->numberValue = root->numberValue;
+    } else if( root->type == jsJSON_TYPE_STRING ) {
         newRoot->stringValue = jsJSON_strdup(root->stringValue);
-    }
-
-    // duplicate children recursively
-    if( root->children != NULL ) {
+    } else if( root->isPacked ) {
+        newRoot->isPacked = true;
+        newRoot->numberArray = jsJSON_allocNumberArray(root->numberArrayLength);
+        memcpy(newRoot->numberArray, root->numberArray, root->numberArrayLength * sizeof(double));
+        newRoot->numberArrayLength = root->numberArrayLength;
+    } else if( root->type == jsJSON_TYPE_OBJECT || root->type == jsJSON_TYPE_ARRAY ) {
+        // duplicate children recursively
         jsJSON* child = root->children;
         while( child != NULL ) {
             jsJSON* newChild = jsJSON_duplicate(child);
@@ -475,4 +948,264 @@ jsJSON* jsJSON_duplicate(const jsJSON* root) {
         }
     }
     return newRoot;
+}
+
+const double* jsJSON_getNumberArray(const jsJSON* root, const char* key, size_t* length) {
+    *length = 0;
+    jsJSON* array = jsJSON_getObject(root, key);
+    if( array == NULL || !array->isPacked ) {
+        return NULL;
+    }
+    *length = array->numberArrayLength;
+    return array->numberArray;
+}
+
+jsJSON* jsJSON_setString(jsJSON* root, const char* key, const char* value) {
+    jsJSON* child = jsJSON_getObject(root, key);
+    if( child == NULL || child->type != jsJSON_TYPE_STRING ) {
+        return NULL;
+    }
+    if( !child->isPending ) {
+        free(child->stringValue);
+    }
+    child->isPending = false;
+    child->numberValue = 0;
+    child->stringValue = jsJSON_strdup(value != NULL ? value : "");
+    jsJSON_markDirty(child);
+    return child;
+}
+
+jsJSON* jsJSON_setNumber(jsJSON* root, const char* key, double value) {
+    jsJSON* child = jsJSON_getObject(root, key);
+    if( child == NULL || child->type != jsJSON_TYPE_NUMBER ) {
+        return NULL;
+    }
+    child->isPending = false;
+    child->numberValue = value;
+    child->stringValue = NULL;
+    jsJSON_markDirty(child);
+    return child;
+}
+
+jsJSON* jsJSON_setBoolean(jsJSON* root, const char* key, bool value) {
+    jsJSON* child = jsJSON_getObject(root, key);
+    if( child == NULL || child->type != jsJSON_TYPE_BOOL ) {
+        return NULL;
+    }
+    child->boolValue = value;
+    jsJSON_markDirty(child);
+    return child;
+}
+
+/**
+ * The raw filter functions below work directly on the JSON text and never
+ * allocate. Every function gets the end of the record so that they never
+ * read past it, records are not null terminated.
+*/
+static const char* jsJSON_Raw_skipWhitespace(const char* p, const char* end) {
+    while( p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') ) {
+        p++;
+    }
+    return p;
+}
+
+// p points at the opening quote, returns the position after the closing quote
+static const char* jsJSON_Raw_skipString(const char* p, const char* end) {
+    p++;
+    while( p < end ) {
+        if( *p == '\\' ) {
+            p += 2;
+        } else if( *p == '"' ) {
+            return p + 1;
+        } else {
+            p++;
+        }
+    }
+    return NULL;
+}
+
+// p points at the first character of a value, returns the position after it
+static const char* jsJSON_Raw_skipValue(const char* p, const char* end) {
+    if( *p == '"' ) {
+        return jsJSON_Raw_skipString(p, end);
+    }
+    if( *p == '{' || *p == '[' ) {
+        size_t depth = 0;
+        while( p < end ) {
+            if( *p == '"' ) {
+                p = jsJSON_Raw_skipString(p, end);
+                if( p == NULL ) return NULL;
+                continue;
+            }
+            if( *p == '{' || *p == '[' ) {
+                depth++;
+            } else if( *p == '}' || *p == ']' ) {
+                depth--;
+                if( depth == 0 ) return p + 1;
+            }
+            p++;
+        }
+        return NULL;
+    }
+    // numbers, true and false
+    while( p < end && *p != ',' && *p != '}' && *p != ']'
+        && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r' ) {
+        p++;
+    }
+    return p;
+}
+
+// p points at the opening brace of an object, returns the start of the
+// value at the given dot separated path or NULL if there is none
+static const char* jsJSON_Raw_find(const char* p, const char* end, const char* path) {
+    const char* dot = strchr(path, '.');
+    size_t segmentLength = dot != NULL ? (size_t)(dot - path) : strlen(path);
+    p++; // jump over the brace
+    while( true ) {
+        p = jsJSON_Raw_skipWhitespace(p, end);
+        if( p == end || *p != '"' ) return NULL;
+        const char* keyStart = p + 1;
+        p = jsJSON_Raw_skipString(p, end);
+        if( p == NULL ) return NULL;
+        size_t keyLength = (size_t)(p - 1 - keyStart);
+        p = jsJSON_Raw_skipWhitespace(p, end);
+        if( p == end || *p != ':' ) return NULL;
+        p = jsJSON_Raw_skipWhitespace(p + 1, end);
+        if( p == end ) return NULL;
+        if( keyLength == segmentLength && memcmp(keyStart, path, keyLength) == 0 ) {
+            if( dot == NULL ) {
+                return p;
+            }
+            if( *p != '{' ) return NULL;
+            return jsJSON_Raw_find(p, end, dot + 1);
+        }
+        p = jsJSON_Raw_skipValue(p, end);
+        if( p == NULL ) return NULL;
+        p = jsJSON_Raw_skipWhitespace(p, end);
+        if( p == end || *p != ',' ) return NULL;
+        p++;
+    }
+}
+
+static bool jsJSON_Raw_matches(const jsJSON_Filter* filter, const char* record, const char* end) {
+    const char* p = jsJSON_Raw_skipWhitespace(record, end);
+    if( p == end || *p != '{' ) return false;
+    const char* value = jsJSON_Raw_find(p, end, filter->path);
+    if( value == NULL ) return false;
+
+    if( filter->op == jsJSON_FILTER_EXISTS ) {
+        return true;
+    } else if( filter->op == jsJSON_FILTER_STRING_EQUALS ) {
+        if( *value != '"' ) return false;
+        const char* after = jsJSON_Raw_skipString(value, end);
+        if( after == NULL ) return false;
+        // like the parser, strings are compared without decoding escapes
+        size_t length = (size_t)(after - 1 - (value + 1));
+        return length == strlen(filter->stringValue)
+            && memcmp(value + 1, filter->stringValue, length) == 0;
+    } else {
+        if( *value != '-' && (*value < 48 || *value > 57) ) return false;
+        const char* after = jsJSON_Raw_skipValue(value, end);
+        double n = jsJSON_spanToNumber(value, (size_t)(after - value));
+        if( filter->op == jsJSON_FILTER_NUMBER_EQUALS ) return n == filter->numberValue;
+        if( filter->op == jsJSON_FILTER_NUMBER_LESS ) return n < filter->numberValue;
+        if( filter->op == jsJSON_FILTER_NUMBER_GREATER ) return n > filter->numberValue;
+    }
+    return false;
+}
+
+bool jsJSON_filterMatches(const jsJSON_Filter* filters, size_t filterCount, const char* record, size_t length) {
+    // blank lines are no records, not even without any filters
+    if( jsJSON_Raw_skipWhitespace(record, record + length) == record + length ) {
+        return false;
+    }
+    for( size_t i = 0; i < filterCount; i++ ) {
+        if( !jsJSON_Raw_matches(&filters[i], record, record + length) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// searches needle in the haystack. memchr() is vectorized in the common C
+// libraries, so this skips over non matching bytes at close to memory speed.
+static const char* jsJSON_Raw_findBytes(const char* p, const char* end, const char* needle, size_t needleLength) {
+    while( (size_t)(end - p) >= needleLength ) {
+        p = memchr(p, needle[0], (size_t)(end - p) - needleLength + 1);
+        if( p == NULL ) return NULL;
+        if( memcmp(p, needle, needleLength) == 0 ) return p;
+        p++;
+    }
+    return NULL;
+}
+
+// every matching record has to contain the compared string value or, for the
+// other operators, the last key of the path. The longest of those candidates
+// is used to skip over records that cannot match without looking at them.
+static const char* jsJSON_Raw_needle(const jsJSON_Filter* filters, size_t filterCount, size_t* needleLength) {
+    const char* needle = NULL;
+    *needleLength = 0;
+    for( size_t i = 0; i < filterCount; i++ ) {
+        const char* candidate = filters[i].path;
+        if( filters[i].op == jsJSON_FILTER_STRING_EQUALS ) {
+            candidate = filters[i].stringValue;
+        } else {
+            const char* dot = strrchr(candidate, '.');
+            if( dot != NULL ) candidate = dot + 1;
+        }
+        size_t length = strlen(candidate);
+        if( length > *needleLength ) {
+            needle = candidate;
+            *needleLength = length;
+        }
+    }
+    return needle;
+}
+
+size_t jsJSON_filterLines(const jsJSON_Filter* filters, size_t filterCount, const char* text, size_t length, bool isFinalChunk, jsJSON_Span* matches, size_t maxMatches, size_t* bytesConsumed) {
+    size_t needleLength;
+    const char* needle = jsJSON_Raw_needle(filters, filterCount, &needleLength);
+    const char* p = text;
+    const char* end = text + length;
+    size_t count = 0;
+
+    if( !isFinalChunk ) {
+        // an unterminated last line may continue in the next chunk, so
+        // it is neither scanned nor consumed
+        while( end > text && end[-1] != '\n' ) {
+            end--;
+        }
+    }
+
+    while( p < end && count < maxMatches ) {
+        const char* lineStart = p;
+        if( needleLength > 0 ) {
+            const char* hit = jsJSON_Raw_findBytes(p, end, needle, needleLength);
+            if( hit == NULL ) {
+                p = end;
+                break;
+            }
+            // only the line containing the hit is a candidate,
+            // everything before it is skipped
+            lineStart = hit;
+            while( lineStart > p && lineStart[-1] != '\n' ) {
+                lineStart--;
+            }
+        }
+        const char* lineEnd = memchr(lineStart, '\n', (size_t)(end - lineStart));
+        if( lineEnd == NULL ) {
+            lineEnd = end;
+        }
+        if( jsJSON_filterMatches(filters, filterCount, lineStart, (size_t)(lineEnd - lineStart)) ) {
+            matches[count].start = lineStart;
+            matches[count].length = (size_t)(lineEnd - lineStart);
+            count++;
+        }
+        p = lineEnd < end ? lineEnd + 1 : end;
+    }
+
+    if( bytesConsumed != NULL ) {
+        *bytesConsumed = (size_t)(p - text);
+    }
+    return count;
 }
\ No newline at end of file
@@ -16,8 +16,32 @@ enum jsJSON_TYPE {
     jsJSON_TYPE_OBJECT
 };
 
+/**
+ * Flags for jsJSON_parseWithFlags(), can be combined with |
+*/
+enum jsJSON_PARSE_FLAGS {
+    jsJSON_PARSE_DEFAULT = 0,
+    // string and number nodes keep a reference to their token in the
+    // input and convert it only when the value is accessed
+    jsJSON_PARSE_LAZY = 1,
+    // arrays that hold only numbers are stored as a packed double array
+    // in the array node instead of one child node per number
+    jsJSON_PARSE_PACK_NUMBERS = 2
+};
+
 typedef struct _jsJSON jsJSON;
 
+/**
+ * Serialized bytes of a cacheable node, see jsJSON_setCacheable()
+*/
+typedef struct jsJSON_Cache {
+    // set when the node or one of its descendants changed
+    bool isDirty;
+    // NULL until the node is serialized
+    char* bytes;
+    size_t length;
+} jsJSON_Cache;
+
 /**
  * jsJSON node structure
 */
@@ -25,20 +49,52 @@ struct _jsJSON {
     // type of the node
     enum jsJSON_TYPE type;
 
+    // value of boolean nodes, kept next to the type where
+    // it does not take any extra space
+    bool boolValue;
+
+    // set while a lazily parsed string or number node holds the raw
+    // token span of its value instead of the value itself
+    bool isPending;
+
+    // set for array nodes that hold only numbers and store them in
+    // numberArray instead of children
+    bool isPacked;
+
     // the key of the node, only relevant for object nodes
     // but not array
     const char* key;
 
-    // values
-    bool boolValue;
-    double numberValue;
-    char* stringValue;
+    union {
+        // values of number and string nodes
+        struct {
+            double numberValue;
+            char* stringValue;
+        };
+        // raw token span in the parsed input of a pending node
+        struct {
+            const char* raw;
+            size_t rawLength;
+        };
+        // values of a packed array node, not NULL for empty
+        // packed arrays either
+        struct {
+            double* numberArray;
+            size_t numberArrayLength;
+        };
+        // points towards linked list of children nodes of object
+        // and array nodes that are not packed
+        jsJSON *children;
+    };
+
+    // only allocated for cacheable nodes, NULL for all others
+    jsJSON_Cache *cache;
+
+    // points towards the node this node was added to, NULL for roots
+    jsJSON *parent;
 
     // points towards linked list of sibblings
     jsJSON *sibblings;
-
-    // points towards linked list of children nodes
-    jsJSON *children;
 };
 
 /**
@@ -68,6 +124,12 @@ jsJSON* jsJSON_newObject(const char *key);
 */
 jsJSON* jsJSON_newArray(const char *key);
 
+/**
+ * Creates a new packed number array JSON node. Duplicates the key string, unless NULL,
+ * and copies the values.
+*/
+jsJSON* jsJSON_newNumberArray(const char *key, const double *values, size_t length);
+
 /**
  * Creates a new string JSON node. Duplicates the key and value string valuesm unless NULL.
 */
@@ -86,6 +148,8 @@ jsJSON* jsJSON_newBool(const char *key, bool value);
 /**
  * Adds a child node to the parent node. 
  * The child node is added to the end of the children list.
+ * If the parent is a packed number array, its numbers are turned into
+ * child nodes first.
 */
 jsJSON* jsJSON_add(jsJSON* parent, jsJSON* child);
 
@@ -118,17 +182,87 @@ jsJSON* jsJSON_addBoolean(jsJSON* parent, const char *key, bool value);
 */
 jsJSON* jsJSON_addNumber(jsJSON* parent, const char *key, double value);
 
+/**
+ * Adds a packed number array node to the parent node.
+*/
+jsJSON* jsJSON_addNumberArray(jsJSON* parent, const char *key, const double *values, size_t length);
+
+/**
+ * Enables or disables caching of the serialized bytes of the given node. A cacheable
+ * node is formatted once by either serializer and then reused as is by both until it
+ * is marked dirty. Disabling frees the cached bytes.
+*/
+void jsJSON_setCacheable(jsJSON* node, bool cacheable);
+
+/**
+ * Marks the given node and all its ancestors dirty so that their cached bytes are
+ * not used anymore. jsJSON_add() and the jsJSON_set*() functions do this already,
+ * call it after changing node fields directly.
+*/
+void jsJSON_markDirty(jsJSON* node);
+
 /**
  * Serializes the JSON tree to a string buffer.
 */
 size_t jsJSON_serializeToStr(const jsJSON* root, char *buffer, size_t bufferSize);
 
+/**
+ * One entry of a vectored serialization. Has the same field order as
+ * struct iovec on POSIX systems so that it can be handed to writev()/sendmsg().
+*/
+typedef struct jsJSON_iovec {
+    const void* base;
+    size_t length;
+} jsJSON_iovec;
+
+/**
+ * Serializes the JSON tree into a list of iovec entries. Structural bytes, keys,
+ * numbers and short strings are copied into the scratch buffer and coalesced.
+ * String values with at least referenceThreshold bytes and clean caches (see
+ * jsJSON_setCacheable()) are not copied but referenced in place. Therefore the iovec
+ * list is only valid until the tree is freed, mutated or serialized again, or the
+ * cacheability of one of its nodes is changed. Large strings of a lazily parsed tree
+ * that were not accessed yet are referenced in the parsed input, which then has to
+ * stay alive as well.
+ * Returns the number of iovec entries used, or 0 if either the iovec array or
+ * the scratch buffer is too small. No null terminator is written.
+*/
+size_t jsJSON_serializeToIovec(const jsJSON* root, jsJSON_iovec* iov, size_t iovCount, char* scratch, size_t scratchSize, size_t referenceThreshold);
+
 /**
  * Parses a JSON string and returns the root node of the tree. Allocates memory internally
  * for all nodes and strings so that the buffer can be savely discarded after parsing.
 */
 jsJSON* jsJSON_parse(const char *json);
 
+/**
+ * Like jsJSON_parse() but with jsJSON_PARSE_FLAGS. With jsJSON_PARSE_LAZY, string
+ * and number values are only converted on first access through the accessor
+ * functions, so the json buffer must stay alive and unchanged as long as the tree
+ * is in use. Keys are always duplicated. Packed number arrays are always converted
+ * right away.
+*/
+jsJSON* jsJSON_parseWithFlags(const char *json, unsigned flags);
+
+/**
+ * Like jsJSON_parseWithFlags() but parses only the first length bytes of json,
+ * which does not need to be null terminated. Useful for single records of a
+ * larger buffer, see jsJSON_filterLines().
+*/
+jsJSON* jsJSON_parseWithLength(const char *json, size_t length, unsigned flags);
+
+/**
+ * Returns the number value of the given number node. Converts and caches
+ * the value of lazily parsed nodes.
+*/
+double jsJSON_numberValue(const jsJSON* node);
+
+/**
+ * Returns the string value of the given string node. Returns a reference.
+ * Converts and caches the value of lazily parsed nodes.
+*/
+char*  jsJSON_stringValue(const jsJSON* node);
+
 /**
  * Returns the string value for the given key in the given object node. Returns a reference.
 */
@@ -144,6 +278,32 @@ double jsJSON_getNumber(const jsJSON* objectNode, const char* key);
 */
 bool   jsJSON_getBoolean(const jsJSON* objectNode, const char* key);
 
+/**
+ * Sets the string value for the given key in the given object node. Duplicates the value.
+ * Returns the changed node, or NULL if there is no string node for the key.
+*/
+jsJSON* jsJSON_setString(jsJSON* objectNode, const char* key, const char* value);
+
+/**
+ * Sets the number value for the given key in the given object node.
+ * Returns the changed node, or NULL if there is no number node for the key.
+*/
+jsJSON* jsJSON_setNumber(jsJSON* objectNode, const char* key, double value);
+
+/**
+ * Sets the boolean value for the given key in the given object node.
+ * Returns the changed node, or NULL if there is no boolean node for the key.
+*/
+jsJSON* jsJSON_setBoolean(jsJSON* objectNode, const char* key, bool value);
+
+/**
+ * Returns the packed values of the number array for the given key in the given object
+ * node and stores their count in length. Returns a reference. Returns NULL if there
+ * is no such array or it is not packed, see jsJSON_PARSE_PACK_NUMBERS. Empty packed
+ * arrays return a non NULL pointer with length 0.
+*/
+const double* jsJSON_getNumberArray(const jsJSON* objectNode, const char* key, size_t* length);
+
 /**
  * Returns the child object node for the given key in the given object node.
 */
@@ -154,5 +314,57 @@ jsJSON* jsJSON_getObject(const jsJSON* objectNode, const char* key);
 */
 jsJSON* jsJSON_duplicate(const jsJSON* root);
 
+/**
+ * Predicate operators of jsJSON_Filter
+*/
+enum jsJSON_FILTER_OP {
+    jsJSON_FILTER_EXISTS,
+    jsJSON_FILTER_STRING_EQUALS,
+    jsJSON_FILTER_NUMBER_EQUALS,
+    jsJSON_FILTER_NUMBER_LESS,
+    jsJSON_FILTER_NUMBER_GREATER
+};
+
+/**
+ * A predicate that is evaluated directly on the raw JSON text of a record
+ * without parsing it.
+*/
+typedef struct jsJSON_Filter {
+    // dot separated path of keys starting at the root object, e.g. "payload.field1"
+    const char* path;
+    enum jsJSON_FILTER_OP op;
+    // compared against for jsJSON_FILTER_STRING_EQUALS, escapes are not decoded
+    const char* stringValue;
+    // compared against for the number operators
+    double numberValue;
+} jsJSON_Filter;
+
+/**
+ * A range of bytes within a larger buffer
+*/
+typedef struct jsJSON_Span {
+    const char* start;
+    size_t length;
+} jsJSON_Span;
+
+/**
+ * Returns true if the JSON object record of the given length satisfies all filters.
+ * Works on the raw text, nothing is allocated. Records that are only whitespace never
+ * match, so without filters every other record matches.
+*/
+bool jsJSON_filterMatches(const jsJSON_Filter* filters, size_t filterCount, const char* record, size_t length);
+
+/**
+ * Scans newline delimited JSON records and stores the spans of the records that
+ * satisfy all filters in matches, at most maxMatches of them. Lines that cannot match
+ * are skipped by a byte search without looking at their structure. Returns the number
+ * of matches. Parse a match with jsJSON_parseWithLength().
+ * Stores the number of scanned bytes in bytesConsumed, unless NULL. The scan continues
+ * from there, either when matches ran full or with the next chunk of a stream. Unless
+ * isFinalChunk is set, a last line without a newline is not scanned and not counted as
+ * consumed, because the rest of the record may still come with the next chunk. Pass
+ * isFinalChunk for the last chunk so that such a line is treated as a complete record.
+*/
+size_t jsJSON_filterLines(const jsJSON_Filter* filters, size_t filterCount, const char* text, size_t length, bool isFinalChunk, jsJSON_Span* matches, size_t maxMatches, size_t* bytesConsumed);
 
 #endif // JS_JSON_H
\ No newline at end of file